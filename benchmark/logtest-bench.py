@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+#
+# Decoder and rule throughput benchmark for the FreeBSD ruleset
+# Copyright (C) 2023, Alonso Cárdenas Márquez <acm@FreeBSD.org>.
+#
+# This program is free software; you can redistribute it
+# and/or modify it under the terms of the GNU General Public
+# License (version 2) as published by the FSF - Free Software
+# Foundation
+#
+# Replays a corpus written by make-corpus.py through the wazuh-logtest
+# socket of a manager running the ruleset under test and reports:
+#
+#   - events/sec over the whole replay,
+#   - for every expected decoder, the share of its lines it decoded and,
+#     for the lines listing fields in the .expected file, the share that
+#     decoded every field with the expected value,
+#   - the share of lines no decoder claimed at all,
+#   - how many events raised each FreeBSD rule.
+#
+# logtest adds a socket round trip per event, so the absolute rate is
+# lower than analysisd's; compare runs of the same corpus on the same
+# manager. With --save the summary is written as JSON, and --baseline
+# compares against such a file and fails when the rate dropped by more
+# than --tolerance percent or a decoder or field match rate went down.
+# The first field mismatches are printed to stderr.
+#
+# Usage: logtest-bench.py [--socket path] [--save file] [--baseline file]
+#                         corpus
+
+import argparse
+import collections
+import json
+import socket
+import struct
+import sys
+import time
+
+LOGTEST_SOCKET = "/var/ossec/queue/sockets/logtest"
+
+# FreeBSD rule IDs, the other rules are counted together.
+RULE_IDS = range(99900, 100001)
+
+# Field mismatches printed during a run.
+MAX_MISMATCHES = 10
+
+
+class Logtest:
+    """One logtest session; the token keeps the session across requests."""
+
+    def __init__(self, path):
+        self.path = path
+        self.token = None
+
+    def _request(self, payload):
+        data = json.dumps(payload).encode()
+        with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+            sock.connect(self.path)
+            sock.sendall(struct.pack("<I", len(data)) + data)
+            size = struct.unpack("<I", self._recv(sock, 4))[0]
+            return json.loads(self._recv(sock, size))
+
+    @staticmethod
+    def _recv(sock, size):
+        buf = b""
+        while len(buf) < size:
+            chunk = sock.recv(size - len(buf))
+            if not chunk:
+                raise ConnectionError("logtest closed the connection")
+            buf += chunk
+        return buf
+
+    def process(self, line):
+        parameters = {"event": line, "log_format": "syslog", "location": "bench"}
+        if self.token:
+            parameters["token"] = self.token
+        reply = self._request({"version": 1,
+                               "origin": {"name": "logtest-bench", "module": "bench"},
+                               "command": "log_processing",
+                               "parameters": parameters})
+        if reply.get("error"):
+            raise RuntimeError("logtest error %s: %s" % (reply["error"], reply.get("message")))
+        self.token = reply["data"].get("token", self.token)
+        return reply["data"]["output"]
+
+    def close(self):
+        if self.token:
+            self._request({"version": 1,
+                           "origin": {"name": "logtest-bench", "module": "bench"},
+                           "command": "remove_session",
+                           "parameters": {"token": self.token}})
+
+
+def read_lines(path):
+    with open(path) as f:
+        return [line.rstrip("\n") for line in f]
+
+
+def parse_expected(line):
+    """Decoder name and {field: value} of one .expected line."""
+    decoder, *fields = line.split("\t")
+    return decoder, dict(field.split("=", 1) for field in fields)
+
+
+def field_value(output, name):
+    """Decoded field of a logtest output, dotted names are nested in data."""
+    value = output.get("data", {})
+    for key in name.split("."):
+        if not isinstance(value, dict):
+            return None
+        value = value.get(key)
+    return None if value is None else str(value)
+
+
+def run(args):
+    lines = read_lines(args.corpus)
+    try:
+        expected = read_lines(args.corpus + ".expected")
+    except FileNotFoundError:
+        expected = ["-"] * len(lines)
+    if len(expected) != len(lines):
+        sys.exit("%s.expected does not match the corpus length" % args.corpus)
+
+    logtest = Logtest(args.socket)
+    per_decoder = collections.defaultdict(lambda: [0, 0])
+    per_fields = collections.defaultdict(lambda: [0, 0])
+    rules = collections.Counter()
+    undecoded = 0
+    mismatches = 0
+
+    start = time.monotonic()
+    for number, (line, want) in enumerate(zip(lines, expected), 1):
+        want, fields = parse_expected(want)
+        output = logtest.process(line)
+        got = output.get("decoder", {}).get("name")
+        if got is None:
+            undecoded += 1
+        if want != "-":
+            per_decoder[want][0] += 1
+            per_decoder[want][1] += got == want
+        if fields:
+            decoded = {name: field_value(output, name) for name in fields}
+            wrong = {name: value for name, value in decoded.items() if value != fields[name]}
+            per_fields[want][0] += 1
+            per_fields[want][1] += not wrong
+            if wrong and mismatches < MAX_MISMATCHES:
+                mismatches += 1
+                print("line %d: %s, expected %s" % (number, ", ".join(
+                    "%s=%s" % item for item in wrong.items()), ", ".join(
+                    "%s=%s" % (name, fields[name]) for name in wrong)), file=sys.stderr)
+        rule = int(output.get("rule", {}).get("id", 0))
+        rules[rule if rule in RULE_IDS else "other"] += 1
+    elapsed = time.monotonic() - start
+    logtest.close()
+
+    return {
+        "events": len(lines),
+        "seconds": round(elapsed, 3),
+        "events_per_sec": round(len(lines) / elapsed, 1) if elapsed else 0.0,
+        "undecoded": round(undecoded / len(lines), 4) if lines else 0.0,
+        "match_rate": {name: round(hit / total, 4)
+                       for name, (total, hit) in sorted(per_decoder.items())},
+        "lines": {name: total for name, (total, _) in sorted(per_decoder.items())},
+        "field_rate": {name: round(hit / total, 4)
+                       for name, (total, hit) in sorted(per_fields.items())},
+        "rules": {str(rule): count for rule, count in sorted(rules.items(), key=str)},
+    }
+
+
+def report(summary):
+    print("events          %d" % summary["events"])
+    print("elapsed         %.3f s" % summary["seconds"])
+    print("events/sec      %.1f" % summary["events_per_sec"])
+    print("undecoded       %.2f%%" % (100 * summary["undecoded"]))
+    print()
+    print("%-20s %10s %10s" % ("decoder", "lines", "matched"))
+    for name, rate in summary["match_rate"].items():
+        print("%-20s %10d %9.2f%%" % (name, summary["lines"][name], 100 * rate))
+    print()
+    print("%-20s %10s" % ("decoder", "fields"))
+    for name, rate in summary["field_rate"].items():
+        print("%-20s %9.2f%%" % (name, 100 * rate))
+    print()
+    print("%-20s %10s" % ("rule", "events"))
+    for rule, count in summary["rules"].items():
+        print("%-20s %10d" % (rule, count))
+
+
+def compare(summary, baseline, tolerance):
+    failures = []
+    floor = baseline["events_per_sec"] * (1 - tolerance / 100)
+    if summary["events_per_sec"] < floor:
+        failures.append("events/sec %.1f is below %.1f (baseline %.1f - %g%%)" % (
+            summary["events_per_sec"], floor, baseline["events_per_sec"], tolerance))
+    for name, rate in baseline["match_rate"].items():
+        if summary["match_rate"].get(name, 0.0) < rate:
+            failures.append("%s matched %.2f%% of its lines, baseline %.2f%%" % (
+                name, 100 * summary["match_rate"].get(name, 0.0), 100 * rate))
+    for name, rate in baseline.get("field_rate", {}).items():
+        if summary["field_rate"].get(name, 0.0) < rate:
+            failures.append("%s decoded the fields of %.2f%% of its lines, baseline %.2f%%" % (
+                name, 100 * summary["field_rate"].get(name, 0.0), 100 * rate))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Replay a log corpus through wazuh-logtest.")
+    parser.add_argument("--socket", default=LOGTEST_SOCKET,
+                        help="logtest socket (default: %(default)s)")
+    parser.add_argument("--save", metavar="FILE", help="write the summary as JSON")
+    parser.add_argument("--baseline", metavar="FILE", help="compare with a saved summary")
+    parser.add_argument("--tolerance", type=float, default=5.0,
+                        help="allowed events/sec drop in percent (default: %(default)s)")
+    parser.add_argument("corpus", help="corpus written by make-corpus.py")
+    args = parser.parse_args()
+
+    summary = run(args)
+    report(summary)
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump(summary, f, indent=2)
+            f.write("\n")
+    if args.baseline:
+        with open(args.baseline) as f:
+            failures = compare(summary, json.load(f), args.tolerance)
+        for failure in failures:
+            print("REGRESSION: " + failure, file=sys.stderr)
+        if failures:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,314 @@
+#!/usr/bin/env python3
+#
+# Benchmark corpus generator for the FreeBSD decoders and rules
+# Copyright (C) 2023, Alonso Cárdenas Márquez <acm@FreeBSD.org>.
+#
+# This program is free software; you can redistribute it
+# and/or modify it under the terms of the GNU General Public
+# License (version 2) as published by the FSF - Free Software
+# Foundation
+#
+# Writes a deterministic FreeBSD log corpus mixing userlog, pkg, pf,
+# OpenBSM, sshd, su, login, kernel, ZFS and periodic report lines, some of them relayed from jails with
+# a "jail:<name> " tag, plus lines of other daemons that none of the
+# FreeBSD decoders should claim. Next to <output> it writes
+# <output>.expected, one line per log line with the decoder name that
+# should match it ("-" for the foreign lines), followed for some lines by
+# tab separated field=value pairs the decoder should extract;
+# logtest-bench.py reads it to report the per-decoder match rates.
+#
+# Usage: make-corpus.py [-n lines] [-s seed] output
+
+import argparse
+import datetime
+import random
+
+HOSTS = ["ifrit", "fw", "build01", "db02"]
+JAILS = ["www1", "www2", "mail", "db"]
+USERS = ["acm", "operator", "backup", "deploy", "www"]
+INVALID_USERS = ["oracle", "admin", "test", "ubnt", "postgres", "git"]
+PACKAGES = [
+    ("nginx", "1.24.0_12,3", "1.26.1,3"),
+    ("openssl", "3.0.13_1,1", "3.0.14,1"),
+    ("php82", "8.2.15", "8.2.16"),
+    ("sudo", "1.9.15p5_4", "1.9.16p1"),
+    ("appjail-devel", "2.9.0.20231111,1", "2.9.0.20231115,1"),
+    ("py311-cryptography", "41.0.7_2,1", "42.0.5,1"),
+    ("curl", "8.6.0", "8.7.1"),
+]
+INTERFACES = ["em0", "vtnet0", "lagg0", "igb1", "epair0b"]
+PF_RULES = ["1", "3", "12", "1.jails.4", "8.ssh.1"]
+AUDIT_PATHS = ["/etc/master.passwd", "/etc/ssh/sshd_config", "/bin/ls",
+               "/usr/local/etc/sudoers", "/etc/rc.conf", "/tmp/x.sh"]
+
+# Relative weight of each source, close to what a jail host usually sends:
+# pf and audit trails dominate, account changes are rare.
+WEIGHTS = [
+    ("pf", 35),
+    ("openbsm", 25),
+    ("sshd", 15),
+    ("other", 14),
+    ("kernel", 2),
+    ("pkg", 3),
+    ("su", 3),
+    ("login", 2),
+    ("userlog", 1),
+    ("periodic", 1),
+]
+
+
+def ipv4(rnd):
+    return "%d.%d.%d.%d" % (rnd.choice([10, 192, 198, 203]),
+                            rnd.randrange(256), rnd.randrange(256),
+                            rnd.randrange(1, 255))
+
+
+def ipv6(rnd):
+    return "2001:db8:%x::%x" % (rnd.randrange(0x10000), rnd.randrange(1, 0x10000))
+
+
+def expect(decoder, fields):
+    """Line of the .expected file: decoder name and the fields to check."""
+    return "\t".join([decoder] + ["%s=%s" % item for item in fields.items()])
+
+
+def jail_tag(rnd):
+    return "jail:%s " % rnd.choice(JAILS) if rnd.random() < 0.1 else ""
+
+
+def syslog(ts, rnd, prog, msg):
+    return "%s %s %s[%d]: %s" % (ts.strftime("%b %e %H:%M:%S"),
+                                 rnd.choice(HOSTS), prog,
+                                 rnd.randrange(100, 99999), msg)
+
+
+def gen_pf(ts, rnd):
+    action = "block" if rnd.random() < 0.7 else "pass"
+    direction = rnd.choice(["in", "out"])
+    if rnd.random() < 0.85:
+        src, dst = ipv4(rnd), ipv4(rnd)
+    else:
+        src, dst = ipv6(rnd), ipv6(rnd)
+    proto = rnd.choice(["tcp", "udp", "ICMP"])
+    if proto == "ICMP":
+        flow = "%s > %s: ICMP echo request, id %d, seq 1, length 64" % (
+            src, dst, rnd.randrange(65536))
+    else:
+        flow = "%s.%d > %s.%d: %s %d" % (
+            src, rnd.randrange(1024, 65536), dst,
+            rnd.choice([22, 25, 53, 80, 443, 3306, 5432]), proto,
+            rnd.randrange(1500))
+    msg = "%s00:00:00.%06d rule %s/0(match): %s %s on %s: %s" % (
+        jail_tag(rnd), rnd.randrange(1000000), rnd.choice(PF_RULES), action,
+        direction, rnd.choice(INTERFACES), flow)
+    return "%s %s pf: %s" % (ts.strftime("%b %e %H:%M:%S"), "fw", msg), "freebsd-pf"
+
+
+def gen_openbsm(ts, rnd):
+    stamp = ts.strftime("%a %b %e %H:%M:%S %Y")
+    user = rnd.choice(USERS + ["root"])
+    pid = rnd.randrange(100, 99999)
+    path = rnd.choice(AUDIT_PATHS)
+    if rnd.random() < 0.6:
+        body = "execve(2),0,%s, + %d msec,exec arg,%s,-l,path,%s," \
+               "attribute,100555,root,wheel,92,4178,0" % (
+                   stamp, rnd.randrange(1000), path, path)
+        result = "return,success,0"
+    else:
+        event = rnd.choice(["open(2) - read", "open(2) - read,write"])
+        body = "%s,0,%s, + %d msec,argument,2,0x0,flags,path,%s" % (
+            event, stamp, rnd.randrange(1000), path)
+        result = rnd.choice(["return,success,3",
+                             "return,failure : Permission denied,-1"])
+    subject = "subject,%s,%s,wheel,%s,wheel,%d,%d,0,0.0.0.0" % (
+        user, rnd.choice([user, "root"]), user, pid, rnd.randrange(100, 9999))
+    size = rnd.randrange(90, 200)
+    line = "header,%d,11,%s,%s,%s,trailer,%d" % (size, body, subject, result, size)
+    return line, expect("openbsm", {"audit.event": body.split(",0,", 1)[0],
+                                    "audit.file.name": path})
+
+
+def gen_sshd(ts, rnd):
+    src = ipv4(rnd)
+    port = rnd.randrange(1024, 65536)
+    kind = rnd.random()
+    if kind < 0.2:
+        msg = "Accepted publickey for %s from %s port %d ssh2: ED25519 " \
+              "SHA256:6Cq2NUBMzz0ZoQ2pVb2hLyG2U0maMhqnA4v6qmcJ4Ws" % (
+                  rnd.choice(USERS), src, port)
+    elif kind < 0.5:
+        msg = "Failed password for %s from %s port %d ssh2" % (
+            rnd.choice(USERS + ["root"]), src, port)
+    elif kind < 0.8:
+        msg = "Failed password for invalid user %s from %s port %d ssh2" % (
+            rnd.choice(INVALID_USERS), src, port)
+    else:
+        msg = "Invalid user %s from %s port %d" % (
+            rnd.choice(INVALID_USERS), src, port)
+    # OpenSSH 9.8+ (FreeBSD 15) logs the authentication from sshd-session.
+    prog = rnd.choice(["sshd", "sshd-session"])
+    return syslog(ts, rnd, prog, jail_tag(rnd) + msg), expect("freebsd-sshd", {"srcip": src})
+
+
+def gen_pkg(ts, rnd):
+    name, old, new = rnd.choice(PACKAGES)
+    kind = rnd.random()
+    if kind < 0.4:
+        msg = "%s-%s installed" % (name, new)
+    elif kind < 0.6:
+        msg = "%s-%s deinstalled" % (name, old)
+    elif kind < 0.95:
+        msg = "%s upgraded: %s -> %s" % (name, old, new)
+    else:
+        msg = "%s reinstalled: %s -> %s" % (name, new, new)
+    return syslog(ts, rnd, "pkg", jail_tag(rnd) + msg), "pkg"
+
+
+def gen_su(ts, rnd):
+    bad = "BAD SU " if rnd.random() < 0.3 else ""
+    msg = "%s%s to root on /dev/pts/%d" % (bad, rnd.choice(USERS), rnd.randrange(8))
+    return syslog(ts, rnd, "su", msg), "freebsd-su"
+
+
+def gen_login(ts, rnd):
+    kind = rnd.random()
+    if kind < 0.3:
+        msg = "ROOT LOGIN (root) ON ttyv%d" % rnd.randrange(8)
+    elif kind < 0.7:
+        msg = "1 LOGIN FAILURE ON ttyv%d, %s" % (rnd.randrange(8), rnd.choice(USERS))
+    else:
+        msg = "%d LOGIN FAILURES FROM %s, %s" % (rnd.randrange(2, 6), ipv4(rnd),
+                                                 rnd.choice(USERS))
+    return syslog(ts, rnd, "login", msg), "freebsd-login"
+
+
+def gen_userlog(ts, rnd):
+    user = rnd.choice(USERS)
+    uid = rnd.randrange(1001, 1100)
+    stamp = ts.strftime("%Y-%m-%d %H:%M:%S")
+    kind = rnd.choice(["useradd", "usermod", "userdel", "groupadd"])
+    if kind in ("useradd", "usermod"):
+        # pw(8) leaves the GECOS field empty unless -c is given.
+        gecos, shell = rnd.choice([("User &", "/bin/sh"), ("", "/usr/local/bin/bash")])
+        tail = "%s(%d):%s(%d):%s:/home/%s:%s" % (user, uid, user, uid, gecos, user, shell)
+        decoder = expect("freebsd-userlog", {"dstuser": user, "uid": uid,
+                                             "home": "/home/" + user, "shell": shell})
+    elif kind == "userdel":
+        tail = "%s(%d) account removed" % (user, uid)
+        decoder = "freebsd-userlog-account"
+    else:
+        tail = "%s(%d)" % (user, uid)
+        decoder = "freebsd-userlog-group"
+    return "%s [root:%s] %s" % (stamp, kind, tail), decoder
+
+
+def gen_kernel(ts, rnd):
+    kind = rnd.random()
+    if kind < 0.5:
+        pid, name = rnd.randrange(100, 99999), rnd.choice(["php-fpm", "node", "python3.11"])
+        jid, uid = rnd.randrange(len(JAILS) + 1), rnd.choice([0, 80, 1001])
+        msg = "pid %d (%s), jid %d, uid %d: exited on signal 11 (core dumped)" % (
+            pid, name, jid, uid)
+        want = expect("freebsd-kernel-exit", {"process.pid": pid, "process.name": name,
+                                              "process.jid": jid, "process.uid": uid,
+                                              "process.signal": 11})
+    elif kind < 0.7:
+        pcb = "0xfffff80%09x" % rnd.randrange(16 ** 9)
+        listen = "%s:%d" % (ipv4(rnd), rnd.choice([80, 443]))
+        queue, occurrences = rnd.randrange(128, 1025), rnd.randrange(1, 500)
+        msg = "sonewconn: pcb %s (%s (proto 6)): Listen queue overflow: " \
+              "%d already in queue awaiting acceptance (%d occurrences), euid 80, " \
+              "rgid 80, jail %d" % (pcb, listen, queue, occurrences,
+                                    rnd.randrange(len(JAILS) + 1))
+        want = expect("freebsd-kernel-sonewconn", {"socket.pcb": pcb, "socket.listen": listen,
+                                                   "socket.proto": 6, "socket.queue": queue,
+                                                   "socket.occurrences": occurrences})
+    else:
+        path = "/dev/gpt/disk%d" % rnd.randrange(8)
+        fields = {"zfs.pool": "tank", "zfs.vdev_path": path}
+        if rnd.random() < 0.5:
+            fields["zfs.event"] = "checksum mismatch"
+            event = "checksum mismatch, zpool=tank path=%s offset=%d size=131072"
+        else:
+            fields["zfs.event"], fields["zfs.error"] = "vdev I/O failure", 5
+            event = "vdev I/O failure, zpool=tank path=%s offset=%d size=131072 error=5"
+        msg = event % (path, rnd.randrange(2 ** 40))
+        return syslog(ts, rnd, "ZFS", msg), expect("freebsd-zfs", fields)
+    return "%s %s kernel: %s" % (ts.strftime("%b %e %H:%M:%S"), rnd.choice(HOSTS), msg), want
+
+
+def gen_periodic(ts, rnd):
+    name, old, new = rnd.choice(PACKAGES)
+    kind = rnd.random()
+    if kind < 0.4:
+        return "%s-%s is vulnerable:" % (name, old), \
+            expect("freebsd-periodic", {"package": name, "version": old})
+    if kind < 0.7:
+        cve = "CVE-%d-%d" % (rnd.randrange(2019, 2024), rnd.randrange(1000, 50000))
+        return "  CVE: %s" % cve, expect("freebsd-periodic", {"vulnerability.cve": cve})
+    if kind < 0.8:
+        problems, packages = rnd.randrange(1, 9), rnd.randrange(1, 5)
+        return "%d problem(s) in %d installed package(s) found." % (problems, packages), \
+            expect("freebsd-periodic", {"pkgaudit.problems": problems,
+                                        "pkgaudit.packages": packages})
+    change = rnd.choice("<>")
+    inode = rnd.randrange(1000, 9999999)
+    path = rnd.choice(["/usr/local/bin/doas", "/usr/local/bin/sudo", "/tmp/x.sh"])
+    return "%s %d -r-sr-xr-x  1 root  wheel  %d %s %s" % (
+        change, inode, rnd.randrange(4096, 400000),
+        ts.strftime("%b %e %H:%M:%S %Y"), path), \
+        expect("freebsd-periodic", {"setuid.change": change, "setuid.inode": inode,
+                                    "setuid.perm": "-r-sr-xr-x", "setuid.owner": "root",
+                                    "setuid.file": path})
+
+
+def gen_other(ts, rnd):
+    kind = rnd.random()
+    if kind < 0.5:
+        msg = syslog(ts, rnd, "/usr/sbin/cron", "(root) CMD (/usr/libexec/atrun)")
+    elif kind < 0.75:
+        msg = syslog(ts, rnd, "dhclient", "New IP Address (em0): %s" % ipv4(rnd))
+    else:
+        msg = syslog(ts, rnd, "ntpd", "leapsecond file ('/var/db/ntpd.leap-seconds.list'): "
+                     "will expire in less than 30 days")
+    return msg, "-"
+
+
+GENERATORS = {
+    "pf": gen_pf,
+    "openbsm": gen_openbsm,
+    "sshd": gen_sshd,
+    "pkg": gen_pkg,
+    "su": gen_su,
+    "login": gen_login,
+    "userlog": gen_userlog,
+    "kernel": gen_kernel,
+    "periodic": gen_periodic,
+    "other": gen_other,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Write a FreeBSD log benchmark corpus.")
+    parser.add_argument("-n", "--lines", type=int, default=100000,
+                        help="number of log lines (default: %(default)s)")
+    parser.add_argument("-s", "--seed", type=int, default=1,
+                        help="random seed, the same seed gives the same corpus")
+    parser.add_argument("output", help="corpus file to write")
+    args = parser.parse_args()
+
+    rnd = random.Random(args.seed)
+    sources = [name for name, _ in WEIGHTS]
+    weights = [weight for _, weight in WEIGHTS]
+    ts = datetime.datetime(2023, 12, 18, 0, 0, 0)
+
+    with open(args.output, "w") as log, open(args.output + ".expected", "w") as expected:
+        for _ in range(args.lines):
+            ts += datetime.timedelta(milliseconds=rnd.randrange(1, 2000))
+            line, want = GENERATORS[rnd.choices(sources, weights)[0]](ts, rnd)
+            log.write(line + "\n")
+            expected.write(want + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+#
+# Per-check cost profiler for the FreeBSD SCA policies
+# Copyright (C) 2023, Alonso Cárdenas Márquez <acm@FreeBSD.org>.
+#
+# This program is free software; you can redistribute it
+# and/or modify it under the terms of the GNU General Public
+# License (version 2) as published by the FSF - Free Software
+# Foundation
+#
+# Runs, on the host to be scanned, the work behind every rule of one or
+# more policies: "c:" runs the command, "f:" reads the file and "d:"
+# reads the files of the directory. It then prints the checks ranked by
+# elapsed time with the rules run, the processes spawned and the bytes
+# read. The requirements block runs first, as in the agent, so the
+# snapshot files read by the checks exist; it is reported as "req".
+#
+# Rule patterns are not evaluated, every rule of a check is run, so the
+# figures are the cost of a check whose rules all have to be evaluated.
+# Process spawns come from the vm.stats.vm.v_*forks counters, which are
+# system wide: profile on an otherwise idle host. Where they are missing
+# one spawn per "c:" rule is assumed. The requirements always refresh the
+# snapshots, whatever the policy cadence. They are written to a private
+# temporary directory, which the "f:" rules are pointed to, so the live
+# snapshots and pacing stamps of the agent are left untouched.
+#
+# Needs PyYAML (pkg install py311-pyyaml).
+#
+# Usage: sca-profile.py [--top N] [--json] policy.yml [policy.yml ...]
+
+import argparse
+import json
+import os
+import shlex
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+import yaml
+
+FORK_OIDS = ["vm.stats.vm.v_forks", "vm.stats.vm.v_vforks", "vm.stats.vm.v_rforks"]
+
+# Where the policies read the snapshots written by freebsd-snapshot.sh.
+SNAPSHOT_DIR = "/var/ossec/tmp/sca/"
+
+# Private copy of the snapshots; the agent's own are never rewritten.
+PRIVATE_DIR = tempfile.mkdtemp(prefix="sca-profile.") + "/"
+
+# Makes freebsd-snapshot.sh treat every paced policy as due and write its
+# snapshots and stamps to the private directory.
+ENVIRONMENT = dict(os.environ, SCA_INTERVAL_SLACK="2147483647",
+                   SNAPSHOT_DIR=PRIVATE_DIR.rstrip("/"))
+
+# The agent kills "c:" commands after commands_timeout, 30 s by default.
+COMMAND_TIMEOUT = 30
+
+
+def fork_count():
+    try:
+        out = subprocess.run(["sysctl", "-n"] + FORK_OIDS, capture_output=True,
+                             text=True, check=True).stdout
+        return sum(int(value) for value in out.split())
+    except (OSError, subprocess.CalledProcessError, ValueError):
+        return None
+
+
+def expand(text, variables):
+    for name, value in variables.items():
+        text = text.replace(name, value)
+    return text
+
+
+def read_file(path):
+    try:
+        with open(path, "rb") as f:
+            return len(f.read())
+    except OSError:
+        return 0
+
+
+def run_rule(rule, variables):
+    """Run the work behind one rule, return (spawns, bytes read)."""
+    rule = expand(rule, variables).replace(SNAPSHOT_DIR, PRIVATE_DIR)
+    if rule.startswith("not "):
+        rule = rule[4:]
+    kind, _, rest = rule.partition(":")
+    target = rest.split(" -> ")[0].strip()
+
+    if kind == "c":
+        try:
+            out = subprocess.run(shlex.split(target), capture_output=True,
+                                 env=ENVIRONMENT, timeout=COMMAND_TIMEOUT).stdout
+        except (OSError, subprocess.TimeoutExpired):
+            out = b""
+        return 1, len(out)
+    if kind == "f":
+        return 0, sum(read_file(path) for path in target.split(","))
+    if kind == "d":
+        total = 0
+        for root, _, files in os.walk(target):
+            total += sum(read_file(os.path.join(root, name)) for name in files)
+        return 0, total
+    return 0, 0
+
+
+def profile(check_id, rules, variables):
+    before = fork_count()
+    start = time.monotonic()
+    spawns = size = 0
+    for rule in rules:
+        forked, read = run_rule(rule, variables)
+        spawns += forked
+        size += read
+    elapsed = time.monotonic() - start
+    after = fork_count()
+    if before is not None and after is not None:
+        # Our own sysctl call between the two samples is not the check's.
+        spawns = max(after - before - 1, 0)
+    return {"id": check_id, "rules": len(rules), "spawns": spawns,
+            "bytes": size, "ms": round(elapsed * 1000, 2)}
+
+
+def profile_policy(path):
+    with open(path) as f:
+        policy = yaml.safe_load(f)
+    variables = policy.get("variables") or {}
+    results = []
+    requirements = policy.get("requirements")
+    if requirements:
+        results.append(profile("req", requirements["rules"], variables))
+    for check in policy.get("checks", []):
+        results.append(profile(check["id"], check.get("rules", []), variables))
+    name = policy["policy"]["id"]
+    for result in results:
+        result["policy"] = name
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Rank SCA checks by cost on this host.")
+    parser.add_argument("--top", type=int, default=0, help="only print the N most expensive checks")
+    parser.add_argument("--json", action="store_true", help="print the results as JSON")
+    parser.add_argument("policies", nargs="+", help="policy files to profile")
+    args = parser.parse_args()
+
+    results = []
+    try:
+        for path in args.policies:
+            results.extend(profile_policy(path))
+    finally:
+        shutil.rmtree(PRIVATE_DIR, ignore_errors=True)
+    results.sort(key=lambda result: result["ms"], reverse=True)
+    if args.top:
+        results = results[:args.top]
+
+    if args.json:
+        json.dump(results, sys.stdout, indent=2)
+        print()
+        return
+
+    print("%-28s %6s %6s %7s %10s %10s" % ("policy", "check", "rules", "spawns", "bytes", "ms"))
+    for r in results:
+        print("%-28s %6s %6d %7d %10d %10.2f" % (r["policy"], r["id"], r["rules"],
+                                                 r["spawns"], r["bytes"], r["ms"]))
+    print("%-28s %6s %6d %7d %10d %10.2f" % (
+        "total", "", sum(r["rules"] for r in results), sum(r["spawns"] for r in results),
+        sum(r["bytes"] for r in results), sum(r["ms"] for r in results)))
+
+
+if __name__ == "__main__":
+    main()
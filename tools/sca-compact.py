@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+#
+# Compact policy generator for the FreeBSD SCA policies
+# Copyright (C) 2023, Alonso Cárdenas Márquez <acm@FreeBSD.org>.
+#
+# This program is free software; you can redistribute it
+# and/or modify it under the terms of the GNU General Public
+# License (version 2) as published by the FSF - Free Software
+# Foundation
+#
+# Splits each policy into a compact policy for the agents and a metadata
+# file for the dashboard side. The compact policy keeps the policy block,
+# the requirements and variables, and for every check only what the SCA
+# engine needs to evaluate and report it: id, title, condition and rules.
+# The description, rationale, remediation, references and compliance
+# mappings go to <outdir>/cis_freebsd_metadata.json keyed by check ID.
+#
+# Policy IDs and file names are unchanged, so a compact policy replaces
+# its full version on the agents and results keep their history on the
+# manager. Regenerate the compact policies whenever the full ones change.
+#
+# Needs PyYAML (pkg install py311-pyyaml).
+#
+# Usage: sca-compact.py -o outdir policy.yml [policy.yml ...]
+
+import argparse
+import json
+import os
+
+import yaml
+
+# Check keys the agent needs; the SCA engine rejects checks without title.
+COMPACT_KEYS = ("id", "title", "condition", "rules")
+
+METADATA = "cis_freebsd_metadata.json"
+
+HEADER = """\
+# Security Configuration Assessment
+# Compact {name} generated by tools/sca-compact.py, do not edit.
+# Check texts and compliance mappings are in {metadata}.
+
+"""
+
+
+class Dumper(yaml.SafeDumper):
+    """Indent sequences under their key, as the hand-written policies do."""
+
+    def increase_indent(self, flow=False, indentless=False):
+        return super().increase_indent(flow, False)
+
+
+def compact(path, metadata):
+    with open(path) as f:
+        policy = yaml.safe_load(f)
+
+    checks = []
+    for check in policy["checks"]:
+        checks.append({key: check[key] for key in COMPACT_KEYS if key in check})
+        extra = {key: value for key, value in check.items() if key not in COMPACT_KEYS}
+        extra["policy"] = policy["policy"]["id"]
+        metadata[str(check["id"])] = extra
+
+    out = {"policy": policy["policy"]}
+    for key in ("requirements", "variables"):
+        if key in policy:
+            out[key] = policy[key]
+    out["checks"] = checks
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Write compact SCA policies and their metadata.")
+    parser.add_argument("-o", "--outdir", required=True, help="directory for the generated files")
+    parser.add_argument("policies", nargs="+", help="full policy files")
+    args = parser.parse_args()
+
+    os.makedirs(args.outdir, exist_ok=True)
+    metadata = {}
+    for path in args.policies:
+        name = os.path.basename(path)
+        policy = compact(path, metadata)
+        with open(os.path.join(args.outdir, name), "w") as f:
+            f.write(HEADER.format(name=name, metadata=METADATA))
+            yaml.dump(policy, f, Dumper=Dumper, sort_keys=False, allow_unicode=True,
+                      width=1000, default_flow_style=False)
+
+    with open(os.path.join(args.outdir, METADATA), "w") as f:
+        json.dump(dict(sorted(metadata.items())), f, indent=2, ensure_ascii=False)
+        f.write("\n")
+
+
+if __name__ == "__main__":
+    main()
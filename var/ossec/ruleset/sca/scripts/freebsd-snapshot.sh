@@ -0,0 +1,300 @@
+#!/bin/sh
+#
+# Security Configuration Assessment
+# Snapshot helper for the FreeBSD SCA policies
+# Copyright (C) 2023, Alonso Cárdenas Márquez <acm@FreeBSD.org>.
+#
+# This program is free software; you can redistribute it
+# and/or modify it under the terms of the GNU General Public
+# License (version 2) as published by the FSF - Free Software
+# Foundation
+#
+# The SCA engine forks every "c:" rule on its own, even when several
+# checks run the same command. Policies call this script once from their
+# requirements block instead; it captures each expensive command output
+# into $SNAPSHOT_DIR and the checks read those files with "f:" rules.
+#
+# Usage: freebsd-snapshot.sh [-t tag -i seconds [-f input ...]] [section ...]
+#
+# Every file is rewritten on each run (empty when the command fails), so
+# a check never evaluates a stale result from a previous scan. The last
+# line printed is "snapshot ok", which the requirements rule matches.
+#
+# The SCA module has a single scan interval for all policies. With -t and
+# -i the script also paces the policy named by the tag: when that policy
+# last ran less than the given number of seconds ago it prints "snapshot
+# skip" instead, the requirements fail and the engine skips the policy for
+# this round, keeping its previous results.
+#
+# Each -f names a file or directory the policy's checks read. A change to
+# any of them (content or metadata, anywhere below a directory) since the
+# policy last ran makes it due at once, so -i only bounds how stale the
+# results of the state that no input file records may get.
+
+SNAPSHOT_DIR=${SNAPSHOT_DIR:-/var/ossec/tmp/sca}
+
+PATH=/sbin:/bin:/usr/sbin:/usr/bin:/usr/local/sbin:/usr/local/bin
+export PATH
+
+# Mountpoints checked by section 1.1 (Filesystem Configuration).
+SCA_FS_PATHS=${SCA_FS_PATHS:-"/tmp /var /var/tmp /var/log /var/audit /usr/home"}
+
+# Kernel parameters read by the policies, queried with a single sysctl(8).
+SCA_SYSCTL_OIDS=${SCA_SYSCTL_OIDS:-"kern.ostype kern.osrelease
+    kern.elf64.aslr.enable kern.elf64.aslr.stack kern.elf64.aslr.shared_page
+    kern.elf64.aslr.pie_enable kern.elf32.aslr.stack
+    kern.coredump kern.corefile
+    kern.features.security_mac kern.features.nfsd kern.features.nfscl
+    net.inet.icmp.drop_redirect net.inet.ip.forwarding net.inet.icmp.bmcastecho
+    net.inet.tcp.syncookies net.inet6.ip6.accept_rtadv net.inet.ip.fw.enable"}
+
+# Number of most recent audit trail files checked by the routine scan.
+SCA_AUDIT_TRAILS=${SCA_AUDIT_TRAILS:-8}
+
+# Scans starting this many seconds early still count as due, so that a
+# policy paced at the module interval is not skipped every other round.
+SCA_INTERVAL_SLACK=${SCA_INTERVAL_SLACK:-300}
+
+# Listing format for the permission checks: "<mode> <owner>:<group> <path>".
+STAT_FMT='%Sp %Su:%Sg %N'
+
+umask 077
+
+# Run a command and atomically publish its output as $SNAPSHOT_DIR/$1.
+snapshot()
+{
+	_name=$1
+	shift
+	_tmp="${SNAPSHOT_DIR}/.${_name}.$$"
+	"$@" > "${_tmp}" 2>/dev/null
+	mv -f "${_tmp}" "${SNAPSHOT_DIR}/${_name}"
+	echo "snapshot ${_name}"
+}
+
+# Kernel parameters as "<name>: <value>" lines. -i skips the OIDs this
+# kernel lacks (no INET6, ipfw not loaded) instead of failing the query;
+# their checks then find no line and fail as before.
+snapshot_sysctl()
+{
+	snapshot sysctl sysctl -i ${SCA_SYSCTL_OIDS}
+}
+
+# Loaded kernel files and every module they contain, including the ones
+# compiled into the kernel itself, as "file <name>" and "module <name>"
+# lines. Read by the module checks of sections 1.1 and 3.
+kld_listing()
+{
+	kldstat -v | awk '
+		$1 ~ /^[0-9]+$/ && NF >= 5 { print "file", $5 }
+		$1 ~ /^[0-9]+$/ && NF == 2 { print "module", $2 }'
+}
+
+snapshot_kldstat()
+{
+	snapshot kldstat kld_listing
+}
+
+# Installed packages as "<name>-<version>" lines, for every "is installed"
+# and "is not installed" check. pkg(8) itself is run directly so a host
+# without it yields an empty listing instead of the bootstrap prompt.
+snapshot_pkg()
+{
+	snapshot pkg_query /usr/local/sbin/pkg query -a '%n-%v'
+}
+
+# 4.2 Configure SSH Server: effective sshd configuration and host keys.
+snapshot_sshd()
+{
+	snapshot sshd_T sshd -T
+	snapshot stat_ssh_keys find /etc/ssh -xdev -type f \
+	    -name 'ssh_host_*_key*' -exec stat -f "${STAT_FMT}" {} +
+}
+
+# 4.3 Configure privilege escalation: the sudoers.d lines read by 4.3.2 to
+# 4.3.6, gathered in one pass over every fragment. Comment lines are kept;
+# the checks exclude them themselves.
+snapshot_sudoers()
+{
+	snapshot sudoers_d find /usr/local/etc/sudoers.d -type f -exec grep -h -E \
+	    'use_pty|logfile=|NOPASSWD|!authenticate|timestamp_timeout=' {} +
+}
+
+# auditd(8) names trail files "<start>.<end>" (or "<start>.not_terminated"
+# for the open one) and rotates them when audit_control's filesz is
+# reached, so they sort chronologically by name. List only the newest
+# $SCA_AUDIT_TRAILS of them: one readdir, no per-file stat, whatever the
+# amount of history kept in /var/audit.
+recent_audit_trails()
+{
+	ls /var/audit | grep -E '^[0-9]{14}\.' | tail -n "${SCA_AUDIT_TRAILS}" |
+	    sed 's|^|/var/audit/|' | xargs stat -f "${STAT_FMT}"
+}
+
+# Event classes of the audit_control "flags:" line, one per line as
+# "<events> <class>", where <events> is "all", "success" (+class) or
+# "failure" (-class), so each class is matched as a whole token.
+audit_flags()
+{
+	awk -F: '$1 == "flags" {
+		n = split($2, class, ",")
+		for (i = 1; i <= n; i++) {
+			c = class[i]
+			gsub(/[ \t]/, "", c)
+			if (c ~ /^\+/)
+				print "success", substr(c, 2)
+			else if (c ~ /^-/)
+				print "failure", substr(c, 2)
+			else if (c != "")
+				print "all", c
+		}
+	}' /etc/security/audit_control
+}
+
+# 5.2 Configure System Accounting: audit configuration and trail files.
+snapshot_audit()
+{
+	snapshot audit_flags audit_flags
+	snapshot stat_audit_config find /etc/security -xdev -type f \
+	    -name 'audit_*' -exec stat -f "${STAT_FMT}" {} +
+	snapshot stat_audit_dir stat -f "${STAT_FMT}" /var/audit
+	snapshot stat_var_audit recent_audit_trails
+}
+
+# Every trail file in /var/audit, for the opt-in deep audit policy.
+snapshot_audit_deep()
+{
+	snapshot stat_var_audit_all find /var/audit -xdev -type f \
+	    -exec stat -f "${STAT_FMT}" {} +
+}
+
+# One "zfs get" for every mountpoint of section 1.1, printed as
+# "<path> <property> <value>". zfs reports the dataset holding each path,
+# so every path is mapped back to the dataset with the longest matching
+# mountpoint, just like "zfs get <property> <path>" resolves it.
+zfs_props()
+{
+	zfs get -H -o name,property,value mountpoint,devices,exec,setuid \
+	    ${SCA_FS_PATHS} | awk -F '\t' -v paths="${SCA_FS_PATHS}" '
+		$2 == "mountpoint" { mnt[$1] = $3; next }
+		{ val[$1, $2] = $3; props[$2] = 1 }
+		END {
+			n = split(paths, p, " ")
+			for (i = 1; i <= n; i++) {
+				best = ""
+				bestlen = 0
+				for (ds in mnt) {
+					m = mnt[ds]
+					if (m !~ /^\// || length(m) <= bestlen)
+						continue
+					if (p[i] == m || m == "/" ||
+					    substr(p[i], 1, length(m) + 1) == m "/") {
+						best = ds
+						bestlen = length(m)
+					}
+				}
+				if (best == "")
+					continue
+				for (prop in props)
+					if ((best, prop) in val)
+						print p[i], prop, val[best, prop]
+			}
+		}'
+}
+
+# 1.1 Filesystem Configuration: mount table and ZFS mount properties.
+snapshot_fs()
+{
+	snapshot mount_p mount -p
+	snapshot zfs_props zfs_props
+}
+
+usage()
+{
+	echo "usage: ${0##*/} [-t tag -i seconds [-f input ...]] [section ...]" >&2
+	exit 1
+}
+
+# Succeed when the policy tagged $1 last ran at least $2 seconds ago, or
+# when one of its inputs changed since then.
+policy_due()
+{
+	_stamp="${SNAPSHOT_DIR}/.$1.stamp"
+	[ -f "${_stamp}" ] || return 0
+	_age=$(( $(date +%s) - $(stat -f %m "${_stamp}") ))
+	[ $(( _age + SCA_INTERVAL_SLACK )) -ge "$2" ] && return 0
+	[ -n "${_inputs}" ] || return 1
+	[ -n "$(find ${_inputs} -newercm "${_stamp}" -print 2>/dev/null |
+	    head -n 1)" ]
+}
+
+_tag=
+_interval=
+_inputs=
+while getopts "t:i:f:" _opt; do
+	case "${_opt}" in
+	f)
+		_inputs="${_inputs} ${OPTARG}"
+		;;
+	t)
+		_tag=${OPTARG}
+		;;
+	i)
+		_interval=${OPTARG}
+		;;
+	*)
+		usage
+		;;
+	esac
+done
+shift $((OPTIND - 1))
+
+if [ -n "${_tag}" ]; then
+	[ -n "${_interval}" ] || usage
+elif [ $# -eq 0 ]; then
+	usage
+fi
+
+mkdir -p "${SNAPSHOT_DIR}" || exit 1
+
+if [ -n "${_tag}" ]; then
+	if ! policy_due "${_tag}" "${_interval}"; then
+		echo "snapshot skip ${_tag}"
+		exit 0
+	fi
+	touch "${SNAPSHOT_DIR}/.${_tag}.stamp"
+fi
+
+for _section in "$@"; do
+	case "${_section}" in
+	audit)
+		snapshot_audit
+		;;
+	audit-deep)
+		snapshot_audit_deep
+		;;
+	fs)
+		snapshot_fs
+		;;
+	kldstat)
+		snapshot_kldstat
+		;;
+	pkg)
+		snapshot_pkg
+		;;
+	sshd)
+		snapshot_sshd
+		;;
+	sudoers)
+		snapshot_sudoers
+		;;
+	sysctl)
+		snapshot_sysctl
+		;;
+	*)
+		echo "${0##*/}: unknown section ${_section}" >&2
+		exit 1
+		;;
+	esac
+done
+
+echo "snapshot ok"